@@ -16,11 +16,32 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    decoder.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    readahead.cpp \
+    upscaler.cpp
 
 HEADERS += \
-    mainwindow.h
+    decoder.h \
+    mainwindow.h \
+    pagering.h \
+    readahead.h \
+    upscaler.h
+
+# 可选的JPEG、WebP快速解码器，qmake时通过pkg-config检测到对应库即启用
+# 其他平台可手动添加 DEFINES += HAVE_TURBOJPEG / HAVE_LIBWEBP 及相应的 INCLUDEPATH、LIBS
+unix {
+    CONFIG += link_pkgconfig
+    packagesExist(libturbojpeg) {
+        PKGCONFIG += libturbojpeg
+        DEFINES += HAVE_TURBOJPEG
+    }
+    packagesExist(libwebp) {
+        PKGCONFIG += libwebp
+        DEFINES += HAVE_LIBWEBP
+    }
+}
 
 FORMS += \
     mainwindow.ui
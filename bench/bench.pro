@@ -0,0 +1,31 @@
+# 性能测试，单独构建：cd bench && qmake && make
+QT       += core gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = bench
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../decoder.cpp \
+    decodebench.cpp \
+    main.cpp \
+    ringbench.cpp
+
+HEADERS += \
+    ../decoder.h \
+    ../pagering.h
+
+# 与主程序相同的可选解码器检测
+unix {
+    CONFIG += link_pkgconfig
+    packagesExist(libturbojpeg) {
+        PKGCONFIG += libturbojpeg
+        DEFINES += HAVE_TURBOJPEG
+    }
+    packagesExist(libwebp) {
+        PKGCONFIG += libwebp
+        DEFINES += HAVE_LIBWEBP
+    }
+}
@@ -0,0 +1,92 @@
+﻿#include "decoder.h"
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QTextStream>
+
+namespace {
+
+const int repeat = 5; // 每个文件每种方式的解码次数
+
+// 文件内容会使用的快速解码器，与decodeImage的判断一致
+QString fastPath(const QByteArray &data) {
+#ifdef HAVE_TURBOJPEG
+    if (data.startsWith("\xFF\xD8\xFF")) {
+        return "turbojpeg";
+    }
+#endif
+#ifdef HAVE_LIBWEBP
+    if (data.size() >= 12 && data.startsWith("RIFF") && data.mid(8, 4) == "WEBP") {
+        return "libwebp";
+    }
+#endif
+    Q_UNUSED(data)
+    return QString();
+}
+
+QImage readerDecode(const QByteArray &data, const QSize &bound) {
+    QBuffer buffer;
+    buffer.setData(data);
+    QImageReader reader(&buffer);
+    auto size = reader.size();
+    if (!bound.isEmpty() && size.isValid() && (size.width() > bound.width() || size.height() > bound.height())) {
+        reader.setScaledSize(size.scaled(bound, Qt::KeepAspectRatio));
+    }
+    return reader.read();
+}
+
+// 返回每秒解码的源图像素数（百万）
+template <typename F>
+double measure(const QByteArray &data, F decode, QSize &out) {
+    QElapsedTimer timer;
+    timer.start();
+    QImage img;
+    for (int i = 0; i < repeat; ++i) {
+        img = decode(data);
+    }
+    auto ns = timer.nsecsElapsed();
+    out = img.size();
+    return ns == 0 || img.isNull() ? 0 : 1e3 * repeat * img.width() * img.height() / ns;
+}
+
+}
+
+// 比较快速解码器与QImageReader在同一批文件上的解码吞吐量，文件内容预先读入内存以排除I/O
+int decodeBench(const QStringList &paths, const QSize &bound) {
+    QTextStream out(stdout);
+    out << "decode throughput, " << repeat << " runs per file, bound " << bound.width() << "x" << bound.height() << "\n";
+    out << "file\tpath\tfull MPix/s\tbounded MPix/s\tbounded size\n";
+    for (auto &path : paths) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            out << path << "\tcannot open\n";
+            continue;
+        }
+        auto data = file.readAll();
+        auto name = QFileInfo(path).fileName();
+        QSize full, scaled;
+        auto fast = fastPath(data);
+        if (!fast.isEmpty()) {
+            auto a = measure(data, [](const QByteArray & d) {
+                return decodeImage(d);
+            }, full);
+            auto b = measure(data, [&bound](const QByteArray & d) {
+                return decodeImage(d, bound);
+            }, scaled);
+            // 吞吐量按输出像素计，缩放解码时以原尺寸折算
+            b = scaled.isEmpty() ? 0 : b * full.width() * full.height() / (scaled.width() * double(scaled.height()));
+            out << name << "\t" << fast << "\t" << a << "\t" << b << "\t" << scaled.width() << "x" << scaled.height() << "\n";
+        }
+        auto a = measure(data, [](const QByteArray & d) {
+            return readerDecode(d, QSize());
+        }, full);
+        auto b = measure(data, [&bound](const QByteArray & d) {
+            return readerDecode(d, bound);
+        }, scaled);
+        b = scaled.isEmpty() ? 0 : b * full.width() * full.height() / (scaled.width() * double(scaled.height()));
+        out << name << "\tqimagereader\t" << a << "\t" << b << "\t" << scaled.width() << "x" << scaled.height() << "\n";
+    }
+    return 0;
+}
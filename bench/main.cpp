@@ -0,0 +1,23 @@
+﻿#include <QCoreApplication>
+#include <QTextStream>
+#include <QStringList>
+#include <QSize>
+
+int ringBench(int flips);
+int decodeBench(const QStringList &paths, const QSize &bound);
+
+// 用法：bench ring [翻页次数]
+//       bench decode 文件...（缩放解码的目标尺寸为1920x1080）
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    auto args = a.arguments();
+    if (args.size() >= 2 && args[1] == "ring") {
+        return ringBench(args.size() >= 3 ? args[2].toInt() : 10000000);
+    }
+    if (args.size() >= 3 && args[1] == "decode") {
+        return decodeBench(args.mid(2), QSize(1920, 1080));
+    }
+    QTextStream(stderr) << "usage: bench ring [flips]\n"
+                        << "       bench decode files...\n";
+    return 1;
+}
@@ -0,0 +1,110 @@
+﻿#include "pagering.h"
+#include <QMap>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+namespace {
+
+// 改为环形缓冲区之前的实现，作为对照
+class ImgMap {
+public:
+    QMap<int, int*> map;
+    int offset = 0;
+    int*& operator[](const int &key) {
+        return map[key + offset];
+    }
+    int* get(const int &key) {
+        auto ptr = map.find(key + offset);
+        if (ptr == map.end()) {
+            return nullptr;
+        } else {
+            return *ptr;
+        }
+    }
+    void shift(const int &v) {
+        offset += v;
+    }
+    void remove(const int &key) {
+        map.remove(key + offset);
+    }
+};
+
+const int window = 4; // 与prefetchNumber一致
+int page;
+
+// 与arrangeImage相同：保证[-window, last]内的页面存在，并移除窗口外的全部页面
+int arrange(ImgMap &imgs, int last) {
+    int sum = 0;
+    for (auto &img : imgs.map) {
+        sum += img != nullptr;
+    }
+    for (int j = -window; j <= last; ++j) {
+        if (imgs.get(j) == nullptr) {
+            imgs[j] = &page;
+        }
+    }
+    while (!imgs.map.isEmpty() && imgs.map.firstKey() - imgs.offset < -window) {
+        imgs.map.remove(imgs.map.firstKey());
+    }
+    while (!imgs.map.isEmpty() && imgs.map.lastKey() - imgs.offset > last) {
+        imgs.map.remove(imgs.map.lastKey());
+    }
+    return sum;
+}
+
+int arrange(PageRing<int*> &imgs, int last) {
+    int sum = 0;
+    imgs.forEach([&sum](int, int* &img) {
+        sum += img != nullptr;
+    });
+    for (int j = -window; j <= last; ++j) {
+        if (imgs.get(j) == nullptr) {
+            imgs[j] = &page;
+        }
+    }
+    while (imgs.size() != 0 && (imgs.firstKey() < -window || imgs.lastKey() > last)) {
+        imgs.remove(imgs.firstKey() < -window ? imgs.firstKey() : imgs.lastKey());
+    }
+    return sum;
+}
+
+// 模拟一次快速翻页：shiftImage移动原点并补上当前页，随后arrangeImage
+template <typename T>
+int flip(T &imgs) {
+    imgs.shift(1);
+    if (imgs.get(0) == nullptr) {
+        imgs[0] = &page;
+    }
+    return arrange(imgs, window);
+}
+
+// resize为true时先以较宽的窗口（多显示8页）排列一次，模拟窗口缩小后继续翻页
+template <typename T>
+void run(QTextStream &out, const char *name, T &imgs, int flips, bool resize) {
+    arrange(imgs, resize ? window + 8 : window);
+    qint64 sum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < flips; ++i) {
+        sum += flip(imgs);
+    }
+    auto ns = timer.nsecsElapsed();
+    out << name << ": " << ns / 1000000 << " ms, " << double(ns) / flips << " ns/flip, "
+        << sum / flips << " pages kept\n";
+}
+
+}
+
+// 对比QMap实现与PageRing在连续翻页时的开销
+int ringBench(int flips) {
+    QTextStream out(stdout);
+    out << "page window, " << flips << " flips\n";
+    for (auto resize : {false, true}) {
+        out << (resize ? "after wide -> narrow resize:\n" : "steady window:\n");
+        ImgMap map;
+        run(out, "  QMap ImgMap", map, flips, resize);
+        PageRing<int*> ring;
+        run(out, "  PageRing   ", ring, flips, resize);
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+﻿#include "decoder.h"
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QMimeDatabase>
+#include <QtMath>
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+#ifdef HAVE_LIBWEBP
+#include <webp/decode.h>
+#endif
+
+namespace {
+
+#if defined(HAVE_TURBOJPEG) || defined(HAVE_LIBWEBP)
+// 按比例缩小到恰好放进bound，不放大
+QSize fitSize(const QSize &size, const QSize &bound) {
+    double r = 1;
+    if (bound.width() > 0) {
+        r = qMin(r, double(bound.width()) / size.width());
+    }
+    if (bound.height() > 0) {
+        r = qMin(r, double(bound.height()) / size.height());
+    }
+    return QSize(qMax(1, qCeil(size.width() * r)), qMax(1, qCeil(size.height() * r)));
+}
+#endif
+
+#ifdef HAVE_TURBOJPEG
+// 在DCT域选择不小于目标尺寸的最小缩放比例
+QImage decodeJpeg(const QByteArray &data, const QSize &bound) {
+    QImage img;
+    auto handle = tjInitDecompress();
+    if (handle == nullptr) {
+        return img;
+    }
+    auto buf = reinterpret_cast<const unsigned char*>(data.constData());
+    int w, h, subsamp, colorspace;
+    if (tjDecompressHeader3(handle, buf, data.size(), &w, &h, &subsamp, &colorspace) == 0) {
+        auto need = fitSize(QSize(w, h), bound);
+        int n, sw = w, sh = h;
+        auto factors = tjGetScalingFactors(&n);
+        for (int i = 0; i < n; ++i) {
+            int tw = TJSCALED(w, factors[i]), th = TJSCALED(h, factors[i]);
+            if (tw >= need.width() && th >= need.height() && tw * qint64(th) < sw * qint64(sh)) {
+                sw = tw;
+                sh = th;
+            }
+        }
+        img = QImage(sw, sh, QImage::Format_RGBX8888);
+        auto failed = tjDecompress2(handle, buf, data.size(), img.bits(), sw, img.bytesPerLine(), sh, TJPF_RGBX, 0) != 0;
+#ifdef TJFLAG_STOPONWARNING
+        // 2.0起可区分警告，扫描件常见的数据截断等警告不影响解码结果
+        failed = failed && tjGetErrorCode(handle) != TJERR_WARNING;
+#endif
+        if (failed) {
+            img = QImage(); // 如CMYK等不支持的格式，交给QImageReader
+        }
+    }
+    tjDestroy(handle);
+    return img;
+}
+#endif
+
+#ifdef HAVE_LIBWEBP
+// 多线程解码，并在解码时直接缩放到目标尺寸
+QImage decodeWebp(const QByteArray &data, const QSize &bound) {
+    auto buf = reinterpret_cast<const uint8_t*>(data.constData());
+    WebPDecoderConfig config;
+    if (!WebPInitDecoderConfig(&config) || WebPGetFeatures(buf, data.size(), &config.input) != VP8_STATUS_OK
+            || config.input.has_animation) {
+        return QImage(); // 动图交给QImageReader
+    }
+    auto size = QSize(config.input.width, config.input.height);
+    auto need = fitSize(size, bound);
+    if (need != size) {
+        config.options.use_scaling = 1;
+        config.options.scaled_width = need.width();
+        config.options.scaled_height = need.height();
+    }
+    config.options.use_threads = 1;
+    QImage img(need, config.input.has_alpha ? QImage::Format_RGBA8888 : QImage::Format_RGBX8888);
+    config.output.colorspace = MODE_RGBA;
+    config.output.is_external_memory = 1;
+    config.output.u.RGBA.rgba = img.bits();
+    config.output.u.RGBA.stride = img.bytesPerLine();
+    config.output.u.RGBA.size = img.sizeInBytes();
+    if (WebPDecode(buf, data.size(), &config) != VP8_STATUS_OK) {
+        img = QImage();
+    }
+    WebPFreeDecBuffer(&config.output);
+    return img;
+}
+#endif
+
+}
+
+QImage decodeImage(const QString &path, const QSize &bound) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+    auto data = file.readAll();
+    file.close();
+    return decodeImage(data, bound);
+}
+
+QImage decodeImage(const QByteArray &data, const QSize &bound) {
+    QImage img;
+#if !defined(HAVE_TURBOJPEG) && !defined(HAVE_LIBWEBP)
+    Q_UNUSED(bound)
+#endif
+#ifdef HAVE_TURBOJPEG
+    if (data.startsWith("\xFF\xD8\xFF")) {
+        img = decodeJpeg(data, bound);
+    }
+#endif
+#ifdef HAVE_LIBWEBP
+    if (data.size() >= 12 && data.startsWith("RIFF") && data.mid(8, 4) == "WEBP") {
+        img = decodeWebp(data, bound);
+    }
+#endif
+    if (img.isNull()) {
+        QMimeDatabase db;
+        auto mime = db.mimeTypeForData(data);
+        QBuffer buffer;
+        buffer.setData(data);
+        img = QImageReader(&buffer, mime.preferredSuffix().toUtf8()).read();
+    }
+    return img;
+}
@@ -0,0 +1,13 @@
+﻿#ifndef DECODER_H
+#define DECODER_H
+
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+
+// 解码图片文件。JPEG、WebP在编译时找到libjpeg-turbo、libwebp的情况下直接解码，否则使用QImageReader
+// bound为解码结果至少需要覆盖的尺寸（宽或高为0表示该方向不限制），仅用于缩小，空则按原尺寸解码
+QImage decodeImage(const QString &path, const QSize &bound = QSize());
+QImage decodeImage(const QByteArray &data, const QSize &bound = QSize()); // 解码内存中的文件内容
+
+#endif // DECODER_H
@@ -1,24 +1,9 @@
 ﻿#include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "decoder.h"
 #include <QClipboard>
 #include <QUrl>
-
-template <typename T>
-class asKeyRange {
-public:
-    asKeyRange(T &data): m_data(data) {}
-
-    auto begin() {
-        return m_data.keyBegin();
-    }
-
-    auto end() {
-        return m_data.keyEnd();
-    }
-
-private:
-    T &m_data;
-};
+#include <QScreen>
 
 MainWindow::MainWindow(QWidget *parent): QMainWindow(parent), ui(new Ui::MainWindow) {
     ui->setupUi(this);
@@ -36,6 +21,22 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent), ui(new Ui::MainWin
                      "滑动、左右方向键、点击页面的左右侧均可翻页\n\n"
                      "在[选项]中可以更改阅读方向");
     imgs[0]->setStyleSheet("font-size:20px;");
+    connect(&upscaler, &Upscaler::finished, this, &MainWindow::applyUpscaled);
+    upscaleTimer.setSingleShot(true);
+    upscaleTimer.setInterval(200);
+    connect(&upscaleTimer, &QTimer::timeout, [this]() {
+        if (upscale) {
+            auto focused = imgs.get(0); // 当前页先排队，工作线程会立即开始处理第一个请求
+            if (focused != nullptr) {
+                requestUpscale(focused);
+            }
+            imgs.forEach([this, focused](int, QLabel * &img) {
+                if (img != focused) {
+                    requestUpscale(img);
+                }
+            });
+        }
+    });
 }
 
 MainWindow::~MainWindow() {
@@ -61,6 +62,7 @@ QLabel* MainWindow::newImg() {
 }
 
 void MainWindow::deleteImg(QLabel* img) {
+    upscaler.cancel(img->property("path").toString());
     imgsBank.append(img);
 }
 
@@ -135,6 +137,7 @@ void MainWindow::openPath(const QString& path) {
             }
         }
     }
+    scheduleReadAhead();
     loadImage();
     arrangeImage();
 }
@@ -149,9 +152,13 @@ void MainWindow::resizeEvent(QResizeEvent*) {
     if (files.empty()) {
         imgs[0]->resize(w, h);
     } else {
-        for (auto &img : imgs.map) {
+        imgs.forEach([this](int, QLabel * &img) {
             img->setVisible(false);
             adjustImage(img);
+        });
+        if (upscale) {
+            upscaler.clear(); // 之前的尺寸已失效
+            upscaleTimer.start();
         }
     }
     panel->resize(w, h);
@@ -186,11 +193,13 @@ void MainWindow::shiftImage(bool left) {
         auto id = focusId + (!sliding && reversed ? 1 : -1);
         if (id >= 0 && id < files.size()) {
             focusId = id;
-            imgs.offset -= 1;
+            imgs.shift(-1);
             auto img = imgs.get(0);
             if (img == nullptr) {
                 img = imgs[0] = newImg();
                 setOneImage(img, id);
+            } else if (upscale) {
+                requestUpscale(img);
             }
             if (sliding) {
                 auto tmp = imgs[0]->height() + gap;
@@ -206,11 +215,13 @@ void MainWindow::shiftImage(bool left) {
         auto id = focusId + (!sliding && reversed ? -1 : 1);
         if (id >= 0 && id < files.size()) {
             focusId = id;
-            imgs.offset += 1;
+            imgs.shift(1);
             auto img = imgs.get(0);
             if (img == nullptr) {
                 img = imgs[0] = newImg();
                 setOneImage(img, id);
+            } else if (upscale) {
+                requestUpscale(img);
             }
             if (sliding) {
                 auto tmp = imgs[-1]->height() + gap;
@@ -223,6 +234,7 @@ void MainWindow::shiftImage(bool left) {
             }
         }
     }
+    scheduleReadAhead();
     if (0 <= focusId && focusId < files.size()) {
         ui->statusBar->showMessage(QString("%1    %2/%3").arg(files[focusId]).arg(focusId + 1).arg(files.size()));
     }
@@ -382,19 +394,30 @@ void MainWindow::loadImage() {
     if (focusId < 0 || focusId >= files.size()) {
         return;
     }
-    for (auto &key : asKeyRange(imgs.map)) {
-        auto t = key - imgs.offset;
-        t = focusId + (!sliding && reversed ? -t : t);
+    upscaler.clear();
+    auto load = [this](int key, QLabel * &img) {
+        auto t = focusId + (!sliding && reversed ? -key : key);
         if (t >= 0 && t < files.size()) {
-            setOneImage(imgs.map[key], t);
+            setOneImage(img, t);
         }
+    };
+    if (imgs.contains(0)) { // 先加载当前页，使其超分请求排在最前
+        load(0, imgs[0]);
     }
+    imgs.forEach([&load](int key, QLabel * &img) {
+        if (key != 0) {
+            load(key, img);
+        }
+    });
 }
 
 void MainWindow::setOneImage(QLabel * label, const int& id) {
     auto path = filePath + files[id];
-    auto mime = db.mimeTypeForFile(path, QMimeDatabase::MatchContent);
-    auto img = QPixmap::fromImage(QImageReader(path, mime.preferredSuffix().toUtf8()).read());
+    // 图像不会显示得比屏幕更大，上下滑动模式下只受宽度限制
+    auto bound = screen()->size() * devicePixelRatioF();
+    auto img = QPixmap::fromImage(decodeImage(path, sliding ? QSize(bound.width(), 0) : bound));
+    label->setProperty("path", img.isNull() ? QString() : path);
+    label->setProperty("sourceSize", img.size());
     if (img.isNull()) {
         auto m = min(imageWidth, imageHeight);
         label->resize(m, m);
@@ -404,7 +427,18 @@ void MainWindow::setOneImage(QLabel * label, const int& id) {
         label->setPixmap(img);
         label->setStyleSheet("color:black;");
         adjustImage(label);
+        if (upscale) {
+            requestUpscale(label);
+        }
+    }
+}
+
+void MainWindow::scheduleReadAhead() {
+    QStringList paths;
+    for (int i = focusId + 1, j = min(focusId + readAheadNumber, int(files.size()) - 1); i <= j; ++i) {
+        paths.append(filePath + files[i]);
     }
+    readAhead.schedule(paths);
 }
 
 void MainWindow::copyFocusedImage() {
@@ -418,7 +452,7 @@ void MainWindow::copyFocusedImage() {
 
 void MainWindow::adjustImage(QLabel * label) {
     auto &h = imageHeight, &w = imageWidth;
-    auto img = label->pixmap();
+    auto img = label->property("sourceSize").toSize(); // 超分后的pixmap尺寸经过取整，比例以原图为准
     auto ih = img.height(), iw = img.width();
     if (sliding) {
         label->resize(w, ih * w / iw);
@@ -432,14 +466,47 @@ void MainWindow::adjustImage(QLabel * label) {
     }
 }
 
+void MainWindow::requestUpscale(QLabel * label) {
+    auto path = label->property("path").toString();
+    auto dpr = devicePixelRatioF();
+    auto target = label->size() * dpr; // 以物理像素计
+    if (path.isEmpty() || label->pixmap().size() == target // 已是目标尺寸
+            || !Upscaler::needed(label->property("sourceSize").toSize(), target)) {
+        return;
+    }
+    auto img = upscaler.cached(path, target);
+    if (img.isNull()) {
+        upscaler.request(path, target, label == imgs.get(0));
+    } else {
+        auto pixmap = QPixmap::fromImage(img);
+        pixmap.setDevicePixelRatio(dpr);
+        label->setPixmap(pixmap);
+    }
+}
+
+void MainWindow::applyUpscaled(const QString & path, const QImage & img) {
+    if (!upscale) {
+        return;
+    }
+    auto dpr = devicePixelRatioF();
+    imgs.forEach([&](int, QLabel * &label) {
+        if (label->size() * dpr == img.size() && label->property("path").toString() == path) {
+            auto pixmap = QPixmap::fromImage(img);
+            pixmap.setDevicePixelRatio(dpr);
+            label->setPixmap(pixmap);
+        }
+    });
+}
+
 void MainWindow::arrangeImage() {
     auto &h = imageHeight, &w = imageWidth;
     bool prevDone = false, nextDone = false;
     int prevPos, nextPos, prefetch = prefetchNumber;
+    int prevEnd = -1, nextEnd = 1; // 两侧第一个不保留的位置
 
-    for (auto &img : imgs.map) {
+    imgs.forEach([](int, QLabel * &img) {
         img->setVisible(false);
-    }
+    });
     auto img = imgs[0];
     if (sliding) {
         prevPos = imageSlide + offset;
@@ -460,11 +527,7 @@ void MainWindow::arrangeImage() {
             if (prevDone) {
                 continue;
             } else if (--prefetch < 0) {
-                if (img != nullptr) {
-                    img->setVisible(false);
-                    imgs.remove(j);
-                    deleteImg(img);
-                }
+                prevEnd = j;
                 prevDone = true;
                 continue;
             }
@@ -472,11 +535,7 @@ void MainWindow::arrangeImage() {
             if (nextDone) {
                 continue;
             } else if ((sliding ? nextPos > h : nextPos > imageWidth) && --prefetch < 0) {
-                if (img != nullptr) {
-                    img->setVisible(false);
-                    imgs.remove(j);
-                    deleteImg(img);
-                }
+                nextEnd = j;
                 nextDone = true;
                 continue;
             }
@@ -490,8 +549,10 @@ void MainWindow::arrangeImage() {
             img->setVisible(true);
         } else {
             if (j < 0) {
+                prevEnd = j;
                 prevDone = true;
             } else {
+                nextEnd = j;
                 nextDone = true;
             }
             continue;
@@ -516,6 +577,16 @@ void MainWindow::arrangeImage() {
             }
         }
     }
+    // 移除窗口外的全部图像，窗口缩小时两侧可能各有多个
+    while (imgs.size() != 0 && (imgs.firstKey() <= prevEnd || imgs.lastKey() >= nextEnd)) {
+        auto key = imgs.firstKey() <= prevEnd ? imgs.firstKey() : imgs.lastKey();
+        img = imgs.get(key);
+        imgs.remove(key);
+        if (img != nullptr) {
+            img->setVisible(false);
+            deleteImg(img);
+        }
+    }
     panel->raise();
     ui->menuBar->raise();
     ui->statusBar->raise();
@@ -577,6 +648,7 @@ void MainWindow::on_read_slide_triggered() {
     }
     if (!sliding) {
         sliding = true;
+        loadImage(); // 翻页模式下按屏幕高度缩小解码的图像需要重新加载
         resizeEvent(nullptr);
     }
 }
@@ -584,14 +656,14 @@ void MainWindow::on_read_slide_triggered() {
 void MainWindow::on_no_gap_triggered(bool checked) {
     if ((noGap[noGapPtr] = checked)) {
         gap = 0;
-        for (auto &img : imgs.map) {
+        imgs.forEach([](int, QLabel * &img) {
             img->setFrameStyle(QFrame::NoFrame);
-        }
+        });
     } else {
         gap = 5;
-        for (auto &img : imgs.map) {
+        imgs.forEach([](int, QLabel * &img) {
             img->setFrameStyle(QFrame::Panel);
-        }
+        });
     }
     arrangeImage();
 }
@@ -600,3 +672,8 @@ void MainWindow::on_copy_image_triggered() {
     copyFocusedImage();
 }
 
+void MainWindow::on_upscale_triggered(bool checked) {
+    upscale = checked;
+    loadImage(); // 关闭时恢复原图，开启时逐一发出请求
+    arrangeImage();
+}
@@ -19,10 +19,13 @@
 #include <QStyle>
 #include <QVariantAnimation>
 #include <QCollator>
-#include <QMimeDatabase>
 #include <QMap>
 #include <QList>
 #include <QTime>
+#include <QTimer>
+#include "pagering.h"
+#include "upscaler.h"
+#include "readahead.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -32,29 +35,8 @@ class MainWindow;
 QT_END_NAMESPACE
 
 const int prefetchNumber = 4; // 预取数量（双向）
-
-class ImgMap {
-public:
-    QMap<int, QLabel*> map;
-    int offset = 0;
-    QLabel*& operator[](const int &key) {
-        return map[key + offset];
-    }
-    QLabel* get(const int &key) {
-        auto ptr = map.find(key + offset);
-        if (ptr == map.end()) {
-            return nullptr;
-        } else {
-            return *ptr;
-        }
-    }
-    void shift(const int &v) {
-        offset += v;
-    }
-    void remove(const int &key) {
-        map.remove(key + offset);
-    }
-};
+const int readAheadNumber = 8; // 预读文件数量（仅向后）
+const qint64 readAheadBytes = 64 << 20; // 预读字节上限
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -72,6 +54,7 @@ private slots:
     void on_no_gap_triggered(bool checked);
 
     void on_copy_image_triggered();
+    void on_upscale_triggered(bool checked);
 
 private:
     Ui::MainWindow *ui;
@@ -80,7 +63,7 @@ private:
     int gap = 5; // 图像间间距
     bool noGap[2] = {false, true}; // 是否有间距，水平默认有间距，垂直默认无间距
     int noGapPtr = 0;
-    ImgMap imgs; // 用于显示图片的容器
+    PageRing<QLabel*> imgs; // 用于显示图片的容器
     QList<QLabel*> imgsBank; // 备用库
     QLabel* panel; // 遮罩
     QWidget* imgContainer;
@@ -95,10 +78,13 @@ private:
     bool reversed = true; // true-向右滑动翻页；false-向左滑动翻页
     bool sliding = false; // true-上下滑动模式
     bool animationKey = true; // 按方向键翻页时是否显示动画
+    bool upscale = false; // 是否对低分辨率图像超分
     int imageHeight, imageWidth = 0, imageTop;
     double imageSlide = 0;
-    QMimeDatabase db;
     QVariantAnimation *ani = nullptr;
+    Upscaler upscaler;
+    QTimer upscaleTimer; // 窗口尺寸停止变化后再请求超分
+    ReadAhead readAhead{readAheadNumber, readAheadBytes};
     void dragEnterEvent(QDragEnterEvent*);
     void dropEvent(QDropEvent*);
     void keyPressEvent(QKeyEvent*);
@@ -111,6 +97,7 @@ private:
     void deleteImg(QLabel*); // "删除"img对象
     void loadImage(); // 从文件夹加载图片，将imgs填满
     void setOneImage(QLabel*, const int&); // 按id加载图片到指定QLabel
+    void scheduleReadAhead(); // 将当前页之后的文件交给预读线程
     void adjustImage(QLabel*); // 调整QLabel尺寸
     void arrangeImage(); // 排列可见图像并根据需要创建新图像
     void shiftImage(bool); // 加载新图像并修改offset，true-左侧图像，false-右侧图像
@@ -118,5 +105,7 @@ private:
     void slideUp(); // 处理上下滑动
     void slideEnd(bool noOffset = false); // 结束上下滑动
     void copyFocusedImage(); // 复制当前图像到剪切板
+    void requestUpscale(QLabel*); // 按QLabel当前尺寸请求超分
+    void applyUpscaled(const QString&, const QImage&); // 超分完成后替换对应QLabel的图像
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,118 @@
+﻿#ifndef PAGERING_H
+#define PAGERING_H
+
+#include <vector>
+
+// 以当前页为原点的定长环形缓冲区，key为相对于focusId的位置
+// shift、插入、移除均为O(1)，仅在窗口跨度超过容量时扩容
+template <typename T>
+class PageRing {
+public:
+    explicit PageRing(int capacity = 32) {
+        int cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        items.resize(cap);
+        used.resize(cap, false);
+        mask = cap - 1;
+    }
+    T& operator[](const int &key) {
+        auto a = key + origin;
+        if (count == 0) {
+            lo = hi = a;
+        } else if (a < lo) {
+            reserveSpan(hi - a + 1);
+            lo = a;
+        } else if (a > hi) {
+            reserveSpan(a - lo + 1);
+            hi = a;
+        }
+        auto slot = a & mask;
+        if (!used[slot]) {
+            used[slot] = true;
+            ++count;
+        }
+        return items[slot];
+    }
+    T get(const int &key) const {
+        auto a = key + origin;
+        if (count == 0 || a < lo || a > hi || !used[a & mask]) {
+            return T();
+        }
+        return items[a & mask];
+    }
+    bool contains(const int &key) const {
+        auto a = key + origin;
+        return count != 0 && a >= lo && a <= hi && used[a & mask];
+    }
+    void shift(const int &v) {
+        origin += v;
+    }
+    void remove(const int &key) {
+        if (!contains(key)) {
+            return;
+        }
+        auto slot = (key + origin) & mask;
+        used[slot] = false;
+        items[slot] = T();
+        if (--count == 0) {
+            return;
+        }
+        while (!used[lo & mask]) { // 收缩边界，摊还O(1)
+            ++lo;
+        }
+        while (!used[hi & mask]) {
+            --hi;
+        }
+    }
+    int size() const {
+        return count;
+    }
+    int firstKey() const { // 最小的key，size()为0时无意义
+        return lo - origin;
+    }
+    int lastKey() const {
+        return hi - origin;
+    }
+    // 按key从小到大遍历，f(key, value)
+    template <typename F>
+    void forEach(F f) {
+        for (int a = lo; count != 0 && a <= hi; ++a) {
+            if (used[a & mask]) {
+                f(a - origin, items[a & mask]);
+            }
+        }
+    }
+
+private:
+    std::vector<T> items;
+    std::vector<bool> used;
+    int mask;
+    int origin = 0; // key为0的元素的绝对位置
+    int lo = 0, hi = 0; // 已占用的绝对位置范围
+    int count = 0;
+    void reserveSpan(int span) {
+        int cap = mask + 1;
+        if (span <= cap) {
+            return;
+        }
+        while (cap < span) {
+            cap <<= 1;
+        }
+        std::vector<T> newItems(cap);
+        std::vector<bool> newUsed(cap, false);
+        int newMask = cap - 1;
+        for (int a = lo; a <= hi; ++a) {
+            if (used[a & mask]) {
+                newItems[a & newMask] = std::move(items[a & mask]);
+                newUsed[a & newMask] = true;
+            }
+        }
+        items.swap(newItems);
+        used.swap(newUsed);
+        mask = newMask;
+    }
+};
+
+#endif // PAGERING_H
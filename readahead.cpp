@@ -0,0 +1,89 @@
+﻿#include "readahead.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ReadAhead::ReadAhead(int depth, qint64 byteLimit, QObject *parent): QThread(parent), depth(depth), byteLimit(byteLimit) {
+    start(QThread::LowPriority);
+}
+
+ReadAhead::~ReadAhead() {
+    {
+        QMutexLocker lock(&mutex);
+        quit = true;
+        queue.clear();
+        cond.wakeOne();
+    }
+    wait();
+}
+
+void ReadAhead::schedule(const QStringList &paths) {
+    QMutexLocker lock(&mutex);
+    queue.clear();
+    bytes = 0;
+    for (auto &path : paths) {
+        if (queue.size() >= depth) {
+            break;
+        }
+        if (!recent.contains(path)) {
+            queue.append(path);
+        }
+    }
+    if (!queue.empty()) {
+        cond.wakeOne();
+    }
+}
+
+void ReadAhead::run() {
+    QMutexLocker lock(&mutex);
+    while (true) {
+        while (queue.empty() && !quit) {
+            cond.wait(&mutex);
+        }
+        if (quit) {
+            return;
+        }
+        auto path = queue.takeFirst();
+        lock.unlock();
+        auto size = QFileInfo(path).size();
+        lock.relock();
+        if (size <= 0 || bytes + size > byteLimit) {
+            if (size > 0) {
+                queue.clear(); // 超出本轮字节上限，等待下一次schedule
+            }
+            continue;
+        }
+        bytes += size;
+        recent.append(path);
+        if (recent.size() > 4 * depth) {
+            recent.removeFirst();
+        }
+        lock.unlock();
+        prefetch(path, size);
+        lock.relock();
+    }
+}
+
+void ReadAhead::prefetch(const QString &path, qint64 size) {
+#ifdef Q_OS_LINUX
+    // 只提交异步预读请求，不等待读取完成，退出时也不会被慢速磁盘阻塞
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+    if (fd >= 0) {
+        ::posix_fadvise(fd, 0, size, POSIX_FADV_WILLNEED);
+        ::close(fd);
+    }
+#else
+    // 其他平台没有统一的预读接口，分块顺序读一遍文件以填充系统缓存，每块之间检查是否退出
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        char buf[1 << 16];
+        while (!quit && file.read(buf, sizeof(buf)) > 0) {
+        }
+    }
+    Q_UNUSED(size)
+#endif
+}
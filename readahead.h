@@ -0,0 +1,32 @@
+﻿#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <atomic>
+
+// 独立的预读线程：按阅读顺序将后续文件读入系统页缓存，使解码时无需等待磁盘
+class ReadAhead : public QThread {
+public:
+    ReadAhead(int depth, qint64 byteLimit, QObject *parent = nullptr);
+    ~ReadAhead();
+    void schedule(const QStringList &paths); // 替换待预读队列，超出depth的部分被丢弃
+
+protected:
+    void run() override;
+
+private:
+    QMutex mutex;
+    QWaitCondition cond;
+    QStringList queue;
+    QStringList recent; // 最近已预读的文件，避免重复读取
+    int depth; // 队列深度
+    qint64 byteLimit; // 每轮预读的字节上限
+    qint64 bytes = 0; // 本轮已预读字节数
+    std::atomic_bool quit{false}; // 预读过程中无锁读取
+    void prefetch(const QString &path, qint64 size);
+};
+
+#endif // READAHEAD_H
@@ -0,0 +1,283 @@
+﻿#include "upscaler.h"
+#include "decoder.h"
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UPSCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const int cacheLimit = 256 * 1024; // 缓存上限（KB）
+const qint64 maxPixels = 3840 * 2160; // 目标面积上限，上下滑动模式下的长条图超出时不做超分
+
+// 平面存储（B、G、R、A各一个平面，另存亮度），四周各有1像素的复制边框
+struct Planes {
+    int w, h;
+    std::vector<uchar> c[4];
+    std::vector<quint16> l;
+    Planes(int w, int h): w(w), h(h), l(size_t(w) * h) {
+        for (auto &p : c) {
+            p.resize(size_t(w) * h);
+        }
+    }
+    uchar* row(int k, int y) {
+        return c[k].data() + size_t(y) * w;
+    }
+    const uchar* row(int k, int y) const {
+        return c[k].data() + size_t(y) * w;
+    }
+    quint16* luma(int y) {
+        return l.data() + size_t(y) * w;
+    }
+    const quint16* luma(int y) const {
+        return l.data() + size_t(y) * w;
+    }
+    void updateLuma(int y) {
+        lumaRow(row(0, y), row(1, y), row(2, y), luma(y), w);
+    }
+    static void lumaRow(const uchar *__restrict b, const uchar *__restrict g, const uchar *__restrict r,
+                        quint16 *__restrict out, int n) {
+        for (int x = 0; x < n; ++x) {
+            out[x] = quint16(b[x] + 2 * g[x] + r[x]);
+        }
+    }
+};
+
+// 方向权重：(a1,a2)方向亮度变化明显更小时为2，(b1,b2)方向明显更小时为0，否则为1
+// 亮度不超过1020，阈值取20/23（约0.87）使乘积仍在16位有符号范围内
+void directionRow(const quint16 *__restrict a1, const quint16 *__restrict a2,
+                  const quint16 *__restrict b1, const quint16 *__restrict b2, uchar *__restrict w, int n) {
+    int x = 0;
+#ifdef UPSCALER_SSE2
+    const __m128i one = _mm_set1_epi16(1), k20 = _mm_set1_epi16(20), k23 = _mm_set1_epi16(23);
+    for (; x + 8 <= n; x += 8) {
+        auto va1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a1 + x));
+        auto va2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a2 + x));
+        auto vb1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b1 + x));
+        auto vb2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b2 + x));
+        auto d1 = _mm_or_si128(_mm_subs_epu16(va1, va2), _mm_subs_epu16(va2, va1));
+        auto d2 = _mm_or_si128(_mm_subs_epu16(vb1, vb2), _mm_subs_epu16(vb2, vb1));
+        auto c1 = _mm_cmplt_epi16(_mm_mullo_epi16(d1, k23), _mm_mullo_epi16(d2, k20));
+        auto c2 = _mm_cmplt_epi16(_mm_mullo_epi16(d2, k23), _mm_mullo_epi16(d1, k20));
+        auto v = _mm_sub_epi16(_mm_add_epi16(one, c2), c1); // 比较结果为-1
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(w + x), _mm_packus_epi16(v, v));
+    }
+#endif
+    for (; x < n; ++x) {
+        int d1 = a1[x] - a2[x], d2 = b1[x] - b2[x];
+        d1 = d1 < 0 ? -d1 : d1;
+        d2 = d2 < 0 ? -d2 : d2;
+        w[x] = uchar((23 * d1 < 20 * d2) + (23 * d2 >= 20 * d1));
+    }
+}
+
+// 按方向权重混合两对像素
+void blendRow(const uchar *__restrict a1, const uchar *__restrict a2, const uchar *__restrict b1,
+              const uchar *__restrict b2, const uchar *__restrict w, uchar *__restrict out, int n) {
+    int x = 0;
+#ifdef UPSCALER_SSE2
+    const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+    auto half = [&](__m128i va1, __m128i va2, __m128i vb1, __m128i vb2, __m128i vw) {
+        auto sa = _mm_add_epi16(va1, va2), sb = _mm_add_epi16(vb1, vb2);
+        auto v = _mm_add_epi16(_mm_mullo_epi16(sa, vw), _mm_mullo_epi16(sb, _mm_sub_epi16(two, vw)));
+        return _mm_srli_epi16(_mm_add_epi16(v, two), 2);
+    };
+    for (; x + 16 <= n; x += 16) {
+        auto va1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a1 + x));
+        auto va2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a2 + x));
+        auto vb1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b1 + x));
+        auto vb2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b2 + x));
+        auto vw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + x));
+        auto lo = half(_mm_unpacklo_epi8(va1, zero), _mm_unpacklo_epi8(va2, zero), _mm_unpacklo_epi8(vb1, zero),
+                       _mm_unpacklo_epi8(vb2, zero), _mm_unpacklo_epi8(vw, zero));
+        auto hi = half(_mm_unpackhi_epi8(va1, zero), _mm_unpackhi_epi8(va2, zero), _mm_unpackhi_epi8(vb1, zero),
+                       _mm_unpackhi_epi8(vb2, zero), _mm_unpackhi_epi8(vw, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < n; ++x) {
+        int wx = w[x];
+        out[x] = uchar(((a1[x] + a2[x]) * wx + (b1[x] + b2[x]) * (2 - wx) + 2) >> 2);
+    }
+}
+
+// 将[0,n)行分块，分发到全局线程池并等待完成
+template <typename F>
+void parallelRows(int n, F f) {
+    auto pool = QThreadPool::globalInstance();
+    int tiles = qMax(1, qMin(n, pool->maxThreadCount()));
+    QSemaphore done;
+    for (int t = 1; t < tiles; ++t) {
+        pool->start([&, t]() {
+            f(n * t / tiles, n * (t + 1) / tiles);
+            done.release();
+        });
+    }
+    f(0, n / tiles);
+    done.acquire(tiles - 1);
+}
+
+// 边缘导向的2倍放大。s(x,y)放在(2x,2y)，d、hp、vp分别为(2x+1,2y+1)、(2x+1,2y)、(2x,2y+1)处的新像素
+void upscale2x(const Planes &s, Planes &d, Planes &hp, Planes &vp) {
+    int W = s.w, H = s.h;
+    // 第一步：由两条对角线插值出d
+    parallelRows(H - 1, [&](int y0, int y1) {
+        std::vector<uchar> w(W);
+        for (int y = y0; y < y1; ++y) {
+            directionRow(s.luma(y), s.luma(y + 1) + 1, s.luma(y) + 1, s.luma(y + 1), w.data(), W - 1);
+            for (int k = 0; k < 4; ++k) {
+                blendRow(s.row(k, y), s.row(k, y + 1) + 1, s.row(k, y) + 1, s.row(k, y + 1), w.data(), d.row(k, y), W - 1);
+            }
+            d.updateLuma(y);
+        }
+    });
+    // 第二步：由水平、垂直方向的原像素与d插值出hp、vp
+    parallelRows(H - 2, [&](int y0, int y1) {
+        std::vector<uchar> w(W);
+        for (int y = y0 + 1; y < y1 + 1; ++y) {
+            directionRow(s.luma(y) + 1, s.luma(y) + 2, d.luma(y - 1) + 1, d.luma(y) + 1, w.data(), W - 2);
+            for (int k = 0; k < 4; ++k) {
+                blendRow(s.row(k, y) + 1, s.row(k, y) + 2, d.row(k, y - 1) + 1, d.row(k, y) + 1, w.data(), hp.row(k, y) + 1, W - 2);
+            }
+            directionRow(s.luma(y) + 1, s.luma(y + 1) + 1, d.luma(y), d.luma(y) + 1, w.data(), W - 2);
+            for (int k = 0; k < 4; ++k) {
+                blendRow(s.row(k, y) + 1, s.row(k, y + 1) + 1, d.row(k, y), d.row(k, y) + 1, w.data(), vp.row(k, y) + 1, W - 2);
+            }
+        }
+    });
+}
+
+QImage upscale2x(const QImage &img) {
+    int w = img.width(), h = img.height(), W = w + 2, H = h + 2;
+    Planes s(W, H), d(W, H), hp(W, H), vp(W, H);
+    parallelRows(H, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            auto line = reinterpret_cast<const QRgb*>(img.constScanLine(qBound(0, y - 1, h - 1)));
+            for (int k = 0; k < 4; ++k) {
+                auto p = s.row(k, y);
+                for (int x = 0; x < W; ++x) {
+                    p[x] = uchar(line[qBound(0, x - 1, w - 1)] >> (8 * k));
+                }
+            }
+            s.updateLuma(y);
+        }
+    });
+    upscale2x(s, d, hp, vp);
+    // 去掉边框并交织四组像素
+    QImage out(2 * w, 2 * h, QImage::Format_ARGB32_Premultiplied);
+    auto pack = [](const Planes & p, int y, int x) {
+        return QRgb(p.row(0, y)[x]) | QRgb(p.row(1, y)[x]) << 8 | QRgb(p.row(2, y)[x]) << 16 | QRgb(p.row(3, y)[x]) << 24;
+    };
+    parallelRows(h, [&](int y0, int y1) {
+        for (int y = y0 + 1; y < y1 + 1; ++y) {
+            auto even = reinterpret_cast<QRgb*>(out.scanLine(2 * y - 2));
+            auto odd = reinterpret_cast<QRgb*>(out.scanLine(2 * y - 1));
+            for (int x = 1; x < W - 1; ++x) {
+                even[2 * x - 2] = pack(s, y, x);
+                even[2 * x - 1] = pack(hp, y, x);
+                odd[2 * x - 2] = pack(vp, y, x);
+                odd[2 * x - 1] = pack(d, y, x);
+            }
+        }
+    });
+    return out;
+}
+
+}
+
+Upscaler::Upscaler(QObject *parent): QObject(parent), cache(cacheLimit) {
+    jobs.setMaxThreadCount(1);
+}
+
+Upscaler::~Upscaler() {
+    jobs.clear();
+    jobs.waitForDone();
+}
+
+bool Upscaler::needed(const QSize &source, const QSize &target) {
+    return !source.isEmpty() && target.width() > source.width() * 5 / 4 && target.height() > source.height() * 5 / 4
+           && qint64(target.width()) * target.height() <= maxPixels;
+}
+
+QImage Upscaler::upscale(const QImage &src, const QSize &target) {
+    if (src.isNull() || target.isEmpty()) {
+        return QImage();
+    }
+    auto img = src.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    while (img.width() < target.width() || img.height() < target.height()) {
+        img = upscale2x(img);
+    }
+    return img.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+QString Upscaler::key(const QString &path, const QSize &target) {
+    return QString("%1|%2x%3").arg(path).arg(target.width()).arg(target.height());
+}
+
+QImage Upscaler::cached(const QString &path, const QSize &target) {
+    QMutexLocker lock(&mutex);
+    auto img = cache.object(key(path, target));
+    return img == nullptr ? QImage() : *img;
+}
+
+void Upscaler::request(const QString &path, const QSize &target, bool focused) {
+    QMutexLocker lock(&mutex);
+    if (cache.contains(key(path, target))) {
+        return;
+    }
+    if (focused) {
+        focus = path;
+    }
+    auto it = wanted.find(path);
+    if (it != wanted.end()) {
+        *it = target; // 尺寸变化时替换旧请求，不再重复排队
+        return;
+    }
+    wanted.insert(path, target);
+    queue.append(path);
+    jobs.start([this]() {
+        run();
+    });
+}
+
+void Upscaler::cancel(const QString &path) {
+    QMutexLocker lock(&mutex);
+    queue.removeOne(path);
+    wanted.remove(path);
+}
+
+void Upscaler::clear() {
+    QMutexLocker lock(&mutex);
+    queue.clear();
+    wanted.clear();
+    jobs.clear();
+}
+
+void Upscaler::run() {
+    QString path;
+    QSize target;
+    {
+        QMutexLocker lock(&mutex);
+        if (queue.empty()) { // 任务已被取消
+            return;
+        }
+        path = queue.contains(focus) ? focus : queue.first();
+        queue.removeOne(path);
+        target = wanted.take(path);
+        if (cache.contains(key(path, target))) {
+            return;
+        }
+    }
+    auto img = upscale(decodeImage(path), target);
+    if (img.isNull()) {
+        return;
+    }
+    {
+        QMutexLocker lock(&mutex);
+        cache.insert(key(path, target), new QImage(img), qMax(1, int(img.sizeInBytes() / 1024)));
+    }
+    emit finished(path, img);
+}
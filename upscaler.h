@@ -0,0 +1,40 @@
+﻿#ifndef UPSCALER_H
+#define UPSCALER_H
+
+#include <QObject>
+#include <QImage>
+#include <QCache>
+#include <QHash>
+#include <QStringList>
+#include <QMutex>
+#include <QThreadPool>
+
+// 后台CPU超分：对低分辨率图像做边缘导向插值，结果按(文件, 目标尺寸)缓存
+class Upscaler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit Upscaler(QObject *parent = nullptr);
+    ~Upscaler();
+    static bool needed(const QSize &source, const QSize &target); // 目标尺寸是否明显大于原图且面积不超过上限
+    static QImage upscale(const QImage &src, const QSize &target); // 放大到目标尺寸（阻塞）
+    QImage cached(const QString &path, const QSize &target); // 查询缓存，未命中返回空图像
+    void request(const QString &path, const QSize &target, bool focused); // 加入后台队列，当前页优先
+    void cancel(const QString &path); // 取消该页尚未开始的任务
+    void clear(); // 取消所有尚未开始的任务
+
+signals:
+    void finished(const QString &path, const QImage &img); // 在工作线程发出
+
+private:
+    QThreadPool jobs; // 单线程逐页执行，每页内部再分块并行
+    QMutex mutex;
+    QCache<QString, QImage> cache; // cost以KB计
+    QStringList queue; // 待处理的页面，按请求顺序
+    QHash<QString, QSize> wanted; // 各页面当前需要的尺寸，只保留最新一次请求
+    QString focus; // 当前页，出队时优先
+    static QString key(const QString &path, const QSize &target);
+    void run();
+};
+
+#endif // UPSCALER_H